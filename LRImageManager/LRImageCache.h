@@ -50,6 +50,10 @@ typedef NS_OPTIONS(NSUInteger, LRCacheStorageOptions)
 - (UIImage *)memCachedImageForURL:(NSURL *)url size:(CGSize)size;
 
 - (UIImage *)diskCachedImageForKey:(NSString *)key;
+
+/**
+ Waits for the mem cache warm-up if it is decoding this very image.
+ */
 - (UIImage *)diskCachedImageForURL:(NSURL *)url size:(CGSize)size;
 
 /**
@@ -80,10 +84,44 @@ cacheStorageOptions:(LRCacheStorageOptions)cacheStorageOptions;
 
 - (void)cleanDisk;
 
+@optional
+
+/**
+ Decodes the hot set persisted in the previous session from disk into memory
+ on a low priority queue. Call it once the cache is configured, typically at
+ the end of application:didFinishLaunchingWithOptions:.
+ */
+- (void)warmUpMemCache;
+
+/**
+ Stops the ongoing warm-up. It is not immediate: the image being decoded, if
+ any, is finished and discarded, and the warm-up stops at the next hot set entry.
+ */
+- (void)cancelMemCacheWarmUp;
+
 @end
 
 #pragma mark - Concrete LRImageCache implementation
 
 @interface LRImageCache : NSObject <LRImageCache>
 
+/** Maximum number of most accessed entries persisted when entering background. */
+@property (nonatomic, assign) NSUInteger maxHotSetCount;
+
+/** Maximum decoded bytes loaded into memory by the launch warm-up. 0 disables it. */
+@property (nonatomic, assign) unsigned long long maxWarmUpCost;
+
+/**
+ First access results for the keys scheduled by the warm-up: a hit means the
+ image was already in memory when first requested.
+ */
+@property (nonatomic, readonly) NSUInteger warmUpHitCount;
+@property (nonatomic, readonly) NSUInteger warmUpMissCount;
+
+/** Time spent by warmUpMemCache on the calling thread. */
+@property (nonatomic, readonly) NSTimeInterval warmUpCallerDuration;
+
+/** Time spent by the last finished warm-up on its queue. */
+@property (nonatomic, readonly) NSTimeInterval warmUpDuration;
+
 @end
@@ -35,18 +35,36 @@
 static const NSTimeInterval kDefaultMaxTimeInCache = 60 * 60 * 24 * 7; // 1 week
 static const unsigned long long kDefaultMaxCacheDirectorySize = 100 * 1024 * 1024; // 100 MB
 static const LRCacheStorageOptions kDefaultCacheStorageOptions = LRCacheStorageOptionsNSDictionary | LRCacheStorageOptionsDiskCache;
+static const NSUInteger kDefaultMaxHotSetCount = 50;
+static const unsigned long long kDefaultMaxWarmUpCost = 20 * 1024 * 1024; // 20 MB
+static const NSUInteger kHotSetTrimFactor = 4;
 
 static NSString *const kImageCacheDirectoryName = @"LRImageCache";
+static NSString *const kHotSetFileExtension = @"hotset";
+
+static NSString *const kHotSetMemCacheKey = @"memCacheKey";
+static NSString *const kHotSetDiskCacheKey = @"diskCacheKey";
+static NSString *const kHotSetCacheStorageOptionsKey = @"cacheStorageOptions";
+static NSString *const kHotSetCostKey = @"cost";
+static NSString *const kHotSetHitsKey = @"hits";
 
 @interface LRImageCache ()
 
 @property (nonatomic, readonly) NSCache *imagesCache;
 @property (nonatomic, readonly) NSMutableDictionary *diskCacheKeysDictionary;
 @property (nonatomic, readonly) NSMutableDictionary *imagesDictionary;
+@property (nonatomic, readonly) NSMutableDictionary *hotSetDictionary;
 @property (nonatomic, readonly) NSString *cacheName;
 @property (nonatomic, readonly) NSString *pathToImageCacheDirectory;
 @property (nonatomic, readonly) dispatch_queue_t ioQueue;
 @property (nonatomic, readonly) dispatch_queue_t syncQueue;
+@property (nonatomic, readonly) dispatch_queue_t warmUpQueue;
+@property (nonatomic, assign) NSUInteger warmUpGeneration;
+@property (nonatomic, readonly) NSMutableSet *warmUpPendingKeys;
+@property (nonatomic, readonly) NSMutableSet *warmUpUnaccessedKeys;
+@property (nonatomic, readonly) NSMutableDictionary *warmUpGroups;
+@property (nonatomic, readonly) NSCountedSet *diskDecodingKeys;
+@property (nonatomic, readonly) NSString *pathToHotSetFile;
 @property (nonatomic, readonly) unsigned long long cacheDirectorySize;
 
 @end
@@ -56,7 +74,10 @@ static NSString *const kImageCacheDirectoryName = @"LRImageCache";
 @synthesize cacheStorageOptions = _cacheStorageOptions;
 @synthesize maxDirectorySize = _maxDirectorySize;
 @synthesize maxTimeInCache = _maxTimeInCache;
-@synthesize pathToImageCacheDirectory = _pathToImageCacheDirectory;
+@synthesize warmUpHitCount = _warmUpHitCount;
+@synthesize warmUpMissCount = _warmUpMissCount;
+@synthesize warmUpCallerDuration = _warmUpCallerDuration;
+@synthesize warmUpDuration = _warmUpDuration;
 
 - (instancetype)initWithName:(NSString *)name
 {
@@ -65,11 +86,23 @@ static NSString *const kImageCacheDirectoryName = @"LRImageCache";
     if (self)
     {
         _cacheName = [name copy];
+        _pathToImageCacheDirectory = [[NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) firstObject] stringByAppendingPathComponent:_cacheName];
+        // Sibling of the cache directory so that disk cleaning never treats it as an image.
+        _pathToHotSetFile = [_pathToImageCacheDirectory stringByAppendingPathExtension:kHotSetFileExtension];
+        _maxHotSetCount = kDefaultMaxHotSetCount;
+        _maxWarmUpCost = kDefaultMaxWarmUpCost;
         _imagesDictionary = [NSMutableDictionary dictionary];
         _imagesCache = [[NSCache alloc] init];
         _ioQueue = dispatch_queue_create("com.LRImageClient.LRImageCacheIOQueue", NULL);
         _syncQueue = dispatch_queue_create("com.LRImageClient.LRImageCacheSyncQueue", NULL);
         _diskCacheKeysDictionary = [NSMutableDictionary dictionary];
+        _hotSetDictionary = [NSMutableDictionary dictionary];
+        _warmUpQueue = dispatch_queue_create("com.LRImageClient.LRImageCacheWarmUpQueue", NULL);
+        dispatch_set_target_queue(_warmUpQueue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0));
+        _warmUpPendingKeys = [NSMutableSet set];
+        _warmUpUnaccessedKeys = [NSMutableSet set];
+        _warmUpGroups = [NSMutableDictionary dictionary];
+        _diskDecodingKeys = [NSCountedSet set];
         
         [[NSNotificationCenter defaultCenter] addObserver:self
                                                  selector:@selector(clearMemCache)
@@ -80,6 +113,11 @@ static NSString *const kImageCacheDirectoryName = @"LRImageCache";
                                                  selector:@selector(cleanDisk)
                                                      name:UIApplicationDidEnterBackgroundNotification
                                                    object:nil];
+        
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(persistHotSet)
+                                                     name:UIApplicationDidEnterBackgroundNotification
+                                                   object:nil];
     }
     
     return self;
@@ -97,6 +135,25 @@ static NSString *const kImageCacheDirectoryName = @"LRImageCache";
     __block UIImage *memCachedImage = nil;
     dispatch_sync(self.syncQueue, ^{
         memCachedImage = self.imagesDictionary[key] ?: [self.imagesCache objectForKey:key];
+        
+        if (memCachedImage)
+        {
+            [self recordHitForMemCacheKey:key];
+        }
+        
+        if ([self.warmUpUnaccessedKeys containsObject:key])
+        {
+            [self.warmUpUnaccessedKeys removeObject:key];
+            
+            if (memCachedImage)
+            {
+                _warmUpHitCount++;
+            }
+            else
+            {
+                _warmUpMissCount++;
+            }
+        }
     });
     
     return memCachedImage;
@@ -133,12 +190,55 @@ static NSString *const kImageCacheDirectoryName = @"LRImageCache";
 {
     if ([[url absoluteString] length] == 0) return nil;
     
+    NSString *memCacheKey = LRMemCacheKey(url, size);
+    
     __block NSString *diskCacheKey = nil;
+    __block dispatch_group_t warmUpGroup = NULL;
     dispatch_sync(self.syncQueue, ^{
+        
         diskCacheKey = LRDiskCacheKey(url, size, self.diskCacheKeysDictionary);
+        
+        // Either wait for the warm-up decoding this very image or keep the warm-up from decoding it again.
+        [self.warmUpPendingKeys removeObject:memCacheKey];
+        warmUpGroup = self.warmUpGroups[memCacheKey];
+        
+        if (!warmUpGroup)
+        {
+            [self.diskDecodingKeys addObject:memCacheKey];
+        }
+    });
+    
+    if (warmUpGroup)
+    {
+        dispatch_group_wait(warmUpGroup, DISPATCH_TIME_FOREVER);
+        
+        __block UIImage *warmedUpImage = nil;
+        dispatch_sync(self.syncQueue, ^{
+            
+            warmedUpImage = self.imagesDictionary[memCacheKey] ?: [self.imagesCache objectForKey:memCacheKey];
+            
+            if (!warmedUpImage)
+            {
+                [self.diskDecodingKeys addObject:memCacheKey];
+            }
+        });
+        
+        if (warmedUpImage) return warmedUpImage;
+    }
+    
+    UIImage *image = [self diskCachedImageForKey:diskCacheKey];
+    
+    dispatch_sync(self.syncQueue, ^{
+        
+        [self.diskDecodingKeys removeObject:memCacheKey];
+        
+        [self recordHotSetEntryForImage:image
+                            memCacheKey:memCacheKey
+                           diskCacheKey:diskCacheKey
+                    cacheStorageOptions:LRCacheStorageOptionsDiskCache];
     });
     
-    return [self diskCachedImageForKey:diskCacheKey];
+    return image;
 }
 
 - (void)diskCachedImageForKey:(NSString *)key
@@ -163,12 +263,15 @@ static NSString *const kImageCacheDirectoryName = @"LRImageCache";
         return;
     };
     
-    __block NSString *diskCacheKey = nil;
-    dispatch_sync(self.syncQueue, ^{
-        diskCacheKey = LRDiskCacheKey(url, size, self.diskCacheKeysDictionary);
+    dispatch_async(self.ioQueue, ^{
+        
+        UIImage *image = [self diskCachedImageForURL:url size:size];
+        
+        if (completionBlock)
+        {
+            completionBlock(image);
+        }
     });
-    
-    [self diskCachedImageForKey:diskCacheKey completionBlock:completionBlock];
 }
 
 - (void)cacheImage:(UIImage *)image
@@ -178,6 +281,13 @@ cacheStorageOptions:(LRCacheStorageOptions)cacheStorageOptions
 {
     [self memCacheImage:image key:memCacheKey cacheStorageOptions:cacheStorageOptions];
     
+    dispatch_sync(self.syncQueue, ^{
+        [self recordHotSetEntryForImage:image
+                            memCacheKey:memCacheKey
+                           diskCacheKey:diskCacheKey
+                    cacheStorageOptions:cacheStorageOptions];
+    });
+    
     if (cacheStorageOptions & LRCacheStorageOptionsDiskCache)
     {
         [self diskCache:image key:diskCacheKey];
@@ -216,13 +326,21 @@ cacheStorageOptions:(LRCacheStorageOptions)cacheStorageOptions
         NSAssert(NO, @"You probably don't want to save in both mem caches.");
     }
     
-    if (shouldSaveInNSDictionary)
+    dispatch_sync(self.syncQueue, ^{
+        [self storeImage:image key:key cacheStorageOptions:cacheStorageOptions];
+    });
+}
+
+// Must be called from syncQueue.
+- (void)storeImage:(UIImage *)image
+               key:(NSString *)key
+cacheStorageOptions:(LRCacheStorageOptions)cacheStorageOptions
+{
+    if (cacheStorageOptions & LRCacheStorageOptionsNSDictionary)
     {
-        dispatch_sync(self.syncQueue, ^{
-            self.imagesDictionary[key] = image;
-        });
+        self.imagesDictionary[key] = image;
     }
-    else if (shouldSaveInNSCache)
+    else if (cacheStorageOptions & LRCacheStorageOptionsNSCache)
     {
         [self.imagesCache setObject:image
                              forKey:key
@@ -276,6 +394,8 @@ cacheStorageOptions:(LRCacheStorageOptions)cacheStorageOptions
 
 - (void)clearMemCache
 {
+    [self cancelMemCacheWarmUp];
+    
     dispatch_sync(self.syncQueue, ^{
         [self.imagesDictionary removeAllObjects];
     });
@@ -296,12 +416,22 @@ cacheStorageOptions:(LRCacheStorageOptions)cacheStorageOptions
 
 - (void)clearDiskCache
 {
+    dispatch_sync(self.syncQueue, ^{
+        [self.hotSetDictionary removeAllObjects];
+    });
+    
     dispatch_async(self.ioQueue, ^{
         
         NSFileManager *fileManager = [NSFileManager defaultManager];
         
         NSError *error = nil;
         
+        if ([fileManager fileExistsAtPath:self.pathToHotSetFile] &&
+            ![fileManager removeItemAtPath:self.pathToHotSetFile error:&error])
+        {
+            LRImageManagerLog(@"Error deleting hot set at path: %@ | error: %@", self.pathToHotSetFile, [error localizedDescription]);
+        }
+        
         if (![fileManager removeItemAtPath:self.pathToImageCacheDirectory error:&error])
         {
             LRImageManagerLog(@"Error deleting cache directory at path: %@ | error: %@", self.pathToImageCacheDirectory, [error localizedDescription]);
@@ -373,14 +503,6 @@ cacheStorageOptions:(LRCacheStorageOptions)cacheStorageOptions
     });
 }
 
-- (NSString *)pathToImageCacheDirectory
-{
-    if (_pathToImageCacheDirectory) return _pathToImageCacheDirectory;
-    
-    NSArray *cachesDirectories = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES);
-    return _pathToImageCacheDirectory = [[cachesDirectories firstObject] stringByAppendingPathComponent:self.cacheName];
-}
-
 - (NSString *)filePathForCacheKey:(NSString *)cacheKey
 {
     return [self.pathToImageCacheDirectory stringByAppendingPathComponent:cacheKey];
@@ -438,6 +560,305 @@ NS_INLINE NSString *LRDiskCacheKey(NSURL *url, CGSize size, NSMutableDictionary
     return cacheKey;
 }
 
+#pragma mark - Hot set
+
+NS_INLINE unsigned long long LRImageCost(UIImage *image)
+{
+    CGImageRef imageRef = image.CGImage;
+    
+    return (unsigned long long)CGImageGetBytesPerRow(imageRef) * CGImageGetHeight(imageRef);
+}
+
+/**
+ Must be called from syncQueue. Only images known to be on disk get a new entry
+ (disk cache storage option or disk hit). Entries get their mem cache storage
+ options, and thus become eligible for the warm-up, once the image is mem cached.
+ */
+- (void)recordHotSetEntryForImage:(UIImage *)image
+                      memCacheKey:(NSString *)memCacheKey
+                     diskCacheKey:(NSString *)diskCacheKey
+              cacheStorageOptions:(LRCacheStorageOptions)cacheStorageOptions
+{
+    if (!image || !memCacheKey || !diskCacheKey) return;
+    
+    LRCacheStorageOptions memCacheStorageOptions = cacheStorageOptions & (LRCacheStorageOptionsNSDictionary | LRCacheStorageOptionsNSCache);
+    
+    NSMutableDictionary *entry = self.hotSetDictionary[memCacheKey];
+    
+    if (!entry)
+    {
+        if (!(cacheStorageOptions & LRCacheStorageOptionsDiskCache)) return;
+        
+        [self trimHotSetIfNeeded];
+        
+        entry = [@{kHotSetMemCacheKey : memCacheKey,
+                   kHotSetHitsKey : @0} mutableCopy];
+        self.hotSetDictionary[memCacheKey] = entry;
+    }
+    
+    entry[kHotSetDiskCacheKey] = diskCacheKey;
+    entry[kHotSetCostKey] = @(LRImageCost(image));
+    
+    if (memCacheStorageOptions != LRCacheStorageOptionsNone)
+    {
+        entry[kHotSetCacheStorageOptionsKey] = @(memCacheStorageOptions);
+        [self recordHitForMemCacheKey:memCacheKey];
+    }
+}
+
+// Must be called from syncQueue.
+- (void)recordHitForMemCacheKey:(NSString *)memCacheKey
+{
+    NSMutableDictionary *entry = self.hotSetDictionary[memCacheKey];
+    entry[kHotSetHitsKey] = @([entry[kHotSetHitsKey] unsignedIntegerValue] + 1);
+}
+
+// Must be called from syncQueue.
+- (void)trimHotSetIfNeeded
+{
+    NSUInteger maxCount = self.maxHotSetCount * kHotSetTrimFactor;
+    
+    if ([self.hotSetDictionary count] < maxCount) return;
+    
+    NSArray *entries = [self sortedHotSetEntries];
+    NSRange discardedRange = NSMakeRange(maxCount / 2, [entries count] - maxCount / 2);
+    
+    for (NSDictionary *entry in [entries subarrayWithRange:discardedRange])
+    {
+        [self.hotSetDictionary removeObjectForKey:entry[kHotSetMemCacheKey]];
+    }
+}
+
+// Must be called from syncQueue.
+- (NSArray *)sortedHotSetEntries
+{
+    NSSortDescriptor *hitsSortDescriptor = [NSSortDescriptor sortDescriptorWithKey:kHotSetHitsKey ascending:NO];
+    
+    return [[self.hotSetDictionary allValues] sortedArrayUsingDescriptors:@[hitsSortDescriptor]];
+}
+
+- (void)persistHotSet
+{
+    NSMutableArray *hotSet = [NSMutableArray array];
+    
+    dispatch_sync(self.syncQueue, ^{
+        
+        for (NSDictionary *entry in [self sortedHotSetEntries])
+        {
+            if ([hotSet count] >= self.maxHotSetCount) break;
+            
+            // Entries not requested in this session age out of the hot set.
+            if (entry[kHotSetCacheStorageOptionsKey] && [entry[kHotSetHitsKey] unsignedIntegerValue] > 0)
+            {
+                [hotSet addObject:[entry copy]];
+            }
+        }
+    });
+    
+    // Keep the previous session hot set if nothing has been requested in this one.
+    if ([hotSet count] == 0) return;
+    
+    // ioQueue may be busy cleaning the disk, don't get suspended before the hot set is written.
+    UIApplication *application = [UIApplication sharedApplication];
+    __block UIBackgroundTaskIdentifier backgroundTaskIdentifier = [application beginBackgroundTaskWithExpirationHandler:^{
+        [application endBackgroundTask:backgroundTaskIdentifier];
+        backgroundTaskIdentifier = UIBackgroundTaskInvalid;
+    }];
+    
+    dispatch_async(self.ioQueue, ^{
+        
+        if (![hotSet writeToFile:self.pathToHotSetFile atomically:YES])
+        {
+            LRImageManagerLog(@"Error persisting hot set at path: %@", self.pathToHotSetFile);
+        }
+        else
+        {
+            LRImageManagerLog(@"Hot set with %lu entries persisted at path: %@", (unsigned long)[hotSet count], self.pathToHotSetFile);
+        }
+        
+        [application endBackgroundTask:backgroundTaskIdentifier];
+        backgroundTaskIdentifier = UIBackgroundTaskInvalid;
+    });
+}
+
+- (void)warmUpMemCache
+{
+    CFAbsoluteTime callTime = CFAbsoluteTimeGetCurrent();
+    
+    unsigned long long maxWarmUpCost = self.maxWarmUpCost;
+    
+    if (maxWarmUpCost == 0) return;
+    
+    __block NSUInteger warmUpGeneration = 0;
+    dispatch_sync(self.syncQueue, ^{
+        warmUpGeneration = ++self.warmUpGeneration;
+    });
+    
+    dispatch_async(self.warmUpQueue, ^{
+        
+        CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+        
+        NSArray *hotSet = [NSArray arrayWithContentsOfFile:self.pathToHotSetFile];
+        NSMutableArray *warmUpEntries = [NSMutableArray array];
+        
+        dispatch_sync(self.syncQueue, ^{
+            
+            if (warmUpGeneration != self.warmUpGeneration) return;
+            
+            unsigned long long remainingCost = maxWarmUpCost;
+            
+            for (NSDictionary *entry in hotSet)
+            {
+                NSString *memCacheKey = entry[kHotSetMemCacheKey];
+                NSString *diskCacheKey = entry[kHotSetDiskCacheKey];
+                unsigned long long cost = [entry[kHotSetCostKey] unsignedLongLongValue];
+                
+                if (!memCacheKey || !diskCacheKey || cost > remainingCost) continue;
+                
+                remainingCost -= cost;
+                
+                // Saves the MD5 computation on the first request too.
+                if (!self.diskCacheKeysDictionary[memCacheKey])
+                {
+                    self.diskCacheKeysDictionary[memCacheKey] = diskCacheKey;
+                }
+                
+                // Warmed up images are only served from memory, keep them in the hot set so their hits
+                // count. With no hits, they are not persisted again.
+                if (!self.hotSetDictionary[memCacheKey])
+                {
+                    NSMutableDictionary *hotSetEntry = [entry mutableCopy];
+                    hotSetEntry[kHotSetHitsKey] = @0;
+                    self.hotSetDictionary[memCacheKey] = hotSetEntry;
+                }
+                
+                [self.warmUpPendingKeys addObject:memCacheKey];
+                [self.warmUpUnaccessedKeys addObject:memCacheKey];
+                [warmUpEntries addObject:entry];
+            }
+        });
+        
+        NSUInteger warmedUpCount = 0;
+        
+        for (NSDictionary *entry in warmUpEntries)
+        {
+            NSString *memCacheKey = entry[kHotSetMemCacheKey];
+            
+            __block BOOL cancelled = NO;
+            __block dispatch_group_t warmUpGroup = NULL;
+            dispatch_sync(self.syncQueue, ^{
+                
+                cancelled = warmUpGeneration != self.warmUpGeneration;
+                
+                // Disk cached image requests remove their key from the pending ones.
+                BOOL shouldWarmUp = !cancelled &&
+                                    [self.warmUpPendingKeys containsObject:memCacheKey] &&
+                                    ![self.diskDecodingKeys containsObject:memCacheKey] &&
+                                    !self.imagesDictionary[memCacheKey] &&
+                                    ![self.imagesCache objectForKey:memCacheKey];
+                
+                [self.warmUpPendingKeys removeObject:memCacheKey];
+                
+                if (shouldWarmUp)
+                {
+                    warmUpGroup = dispatch_group_create();
+                    dispatch_group_enter(warmUpGroup);
+                    self.warmUpGroups[memCacheKey] = warmUpGroup;
+                }
+            });
+            
+            if (cancelled) break;
+            if (!warmUpGroup) continue;
+            
+            UIImage *image = [self diskCachedImageForKey:entry[kHotSetDiskCacheKey]];
+            
+            dispatch_sync(self.syncQueue, ^{
+                
+                cancelled = warmUpGeneration != self.warmUpGeneration;
+                
+                if (!image)
+                {
+                    // Gone from disk, it must not take part in later warm-ups.
+                    [self.hotSetDictionary removeObjectForKey:memCacheKey];
+                }
+                else if (!cancelled)
+                {
+                    [self storeImage:image
+                                 key:memCacheKey
+                 cacheStorageOptions:[entry[kHotSetCacheStorageOptionsKey] unsignedIntegerValue]];
+                }
+                
+                [self.warmUpGroups removeObjectForKey:memCacheKey];
+                dispatch_group_leave(warmUpGroup);
+            });
+            
+            if (image && !cancelled) warmedUpCount++;
+        }
+        
+        CFAbsoluteTime endTime = CFAbsoluteTimeGetCurrent();
+        
+        dispatch_sync(self.syncQueue, ^{
+            _warmUpDuration = endTime - startTime;
+        });
+        
+        LRImageManagerLog(@"Mem cache warm-up loaded %lu of %lu hot set entries in %.1f ms", (unsigned long)warmedUpCount, (unsigned long)[hotSet count], (endTime - startTime) * 1000.0);
+    });
+    
+    CFAbsoluteTime callDuration = CFAbsoluteTimeGetCurrent() - callTime;
+    
+    dispatch_sync(self.syncQueue, ^{
+        _warmUpCallerDuration = callDuration;
+    });
+}
+
+- (void)cancelMemCacheWarmUp
+{
+    dispatch_sync(self.syncQueue, ^{
+        self.warmUpGeneration++;
+        [self.warmUpPendingKeys removeAllObjects];
+    });
+}
+
+- (NSUInteger)warmUpHitCount
+{
+    __block NSUInteger warmUpHitCount = 0;
+    dispatch_sync(self.syncQueue, ^{
+        warmUpHitCount = _warmUpHitCount;
+    });
+    
+    return warmUpHitCount;
+}
+
+- (NSUInteger)warmUpMissCount
+{
+    __block NSUInteger warmUpMissCount = 0;
+    dispatch_sync(self.syncQueue, ^{
+        warmUpMissCount = _warmUpMissCount;
+    });
+    
+    return warmUpMissCount;
+}
+
+- (NSTimeInterval)warmUpCallerDuration
+{
+    __block NSTimeInterval warmUpCallerDuration = 0;
+    dispatch_sync(self.syncQueue, ^{
+        warmUpCallerDuration = _warmUpCallerDuration;
+    });
+    
+    return warmUpCallerDuration;
+}
+
+- (NSTimeInterval)warmUpDuration
+{
+    __block NSTimeInterval warmUpDuration = 0;
+    dispatch_sync(self.syncQueue, ^{
+        warmUpDuration = _warmUpDuration;
+    });
+    
+    return warmUpDuration;
+}
+
 - (NSTimeInterval)maxTimeInCache
 {
     return _maxTimeInCache ?: (_maxTimeInCache = kDefaultMaxTimeInCache);